@@ -3,6 +3,8 @@
 #include "handler.h"
 #include "response.h"
 #include "utils.h"
+#include "trace.h"
+#include "proxy.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -97,6 +99,8 @@ void handle_static_request(int sockfd, const HttpRequest *req) {
         return;
     }
 
+    trace_mark(TRACE_FS_RESOLVED);
+
     HttpResponseInfo info = {0};
     info.status_code = 200;
     info.status_message = "OK";
@@ -173,12 +177,15 @@ void handle_calc_request(int sockfd, const HttpRequest *req) {
 // Route incoming requests to appropriate handlers based on method and URI.
 void handle_request(int sockfd, const HttpRequest *req) {
     printf("Received Request: %s %s %s\n", req->method, req->uri, req->version);
+    trace_set_request(req->method, req->uri);
 
     if (strcmp(req->method, "GET") != 0) {
         send_error_response(sockfd, 405, "Method Not Allowed", "Only GET method is supported for this resource.");
         return;
     }
 
+    trace_mark(TRACE_ROUTED);
+
     if (strncmp(req->uri, "/static/", 8) == 0) {
         handle_static_request(sockfd, req);
     } else if (strncmp(req->uri, "/calc/", 6) == 0) {
@@ -188,6 +195,9 @@ void handle_request(int sockfd, const HttpRequest *req) {
         strncpy(fake_req.uri, "/static/index.html", sizeof(fake_req.uri)-1);
         fake_req.uri[sizeof(fake_req.uri)-1] = '\0';
         handle_static_request(sockfd, &fake_req);
+    } else if (proxy_matches(req->uri)) {
+        // Checked last so built-in routes still work with a catch-all prefix such as "/".
+        handle_proxy_request(sockfd, req);
     }
     else {
         send_error_response(sockfd, 404, "Not Found", "The requested resource was not found on this server.");
@@ -15,12 +15,19 @@
 #include "request.h"
 #include "handler.h"
 #include "response.h"
+#include "trace.h"
+#include "proxy.h"
 
 #define DEFAULT_PORT 80
 #define MAX_CONNECTIONS 10
 
 volatile sig_atomic_t server_fd = -1;
 
+typedef struct {
+    int sockfd;
+    uint64_t accept_ns;
+} ClientConnection;
+
 // Signal handler to close listening socket and exit cleanly.
 void handle_shutdown(int sig) {
     (void)sig;
@@ -29,6 +36,7 @@ void handle_shutdown(int sig) {
         close(server_fd);
         server_fd = -1;
     }
+    trace_close_file();
     exit(0);
 }
 
@@ -36,7 +44,10 @@ void handle_shutdown(int sig) {
 void *client_handler_thread(void *arg) {
     pthread_detach(pthread_self());
 
-    int client_sockfd = (int)(intptr_t)arg;
+    ClientConnection *conn = arg;
+    int client_sockfd = conn->sockfd;
+    trace_begin(conn->accept_ns);
+    free(conn);
 
     printf("Thread %lu: Handling connection on socket %d\n", pthread_self(), client_sockfd);
 
@@ -52,6 +63,8 @@ void *client_handler_thread(void *arg) {
          fprintf(stderr, "Thread %lu: Client disconnected on socket %d during request read.\n", pthread_self(), client_sockfd);
     }
 
+    trace_end();
+
     printf("Thread %lu: Closing connection on socket %d\n", pthread_self(), client_sockfd);
     close(client_sockfd);
     return NULL;
@@ -61,8 +74,10 @@ void *client_handler_thread(void *arg) {
 int main(int argc, char *argv[]) {
     int port = DEFAULT_PORT;
     int opt;
+    const char *trace_path = NULL;
+    unsigned trace_sample_rate = 1;
 
-    while ((opt = getopt(argc, argv, "p:")) != -1) {
+    while ((opt = getopt(argc, argv, "p:tT:s:x:u:b:")) != -1) {
         switch (opt) {
             case 'p':
                 port = atoi(optarg);
@@ -71,12 +86,38 @@ int main(int argc, char *argv[]) {
                     return 1;
                 }
                 break;
+            case 't':
+                trace_enable_server_timing();
+                break;
+            case 'T':
+                trace_path = optarg;
+                break;
+            case 's':
+                if (atoi(optarg) <= 0) {
+                    fprintf(stderr, "Invalid trace sample rate: %s\n", optarg);
+                    return 1;
+                }
+                trace_sample_rate = (unsigned)atoi(optarg);
+                break;
+            case 'x':
+                if (proxy_set_prefix(optarg) < 0) return 1;
+                break;
+            case 'u':
+                if (proxy_add_upstream(optarg) < 0) return 1;
+                break;
+            case 'b':
+                if (proxy_set_balance(optarg) < 0) return 1;
+                break;
             default:
-                fprintf(stderr, "Usage: %s [-p port]\n", argv[0]);
+                fprintf(stderr, "Usage: %s [-p port] [-t] [-T trace_file] [-s sample_rate] [-x proxy_prefix -u upstream ... [-b rr|lc]]\n", argv[0]);
                 return 1;
         }
     }
 
+    if (trace_path && trace_open_file(trace_path, trace_sample_rate) < 0) {
+        return 1;
+    }
+
     struct sockaddr_in server_addr;
     int sockfd;
 
@@ -109,10 +150,16 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    if (proxy_start() < 0) {
+        close(sockfd);
+        return 1;
+    }
+
     printf("Server listening on port %d...\n", port);
 
     signal(SIGINT, handle_shutdown);
     signal(SIGTERM, handle_shutdown);
+    signal(SIGPIPE, SIG_IGN);
 
     struct sockaddr_in client_addr;
     socklen_t client_len = sizeof(client_addr);
@@ -121,6 +168,7 @@ int main(int argc, char *argv[]) {
     while (1) {
         printf("Waiting for new connection...\n");
         client_sockfd = accept(sockfd, (struct sockaddr *)&client_addr, &client_len);
+        uint64_t accept_ns = trace_now();
 
         if (client_sockfd < 0) {
             if (errno == EINTR && server_fd == -1) {
@@ -135,9 +183,19 @@ int main(int argc, char *argv[]) {
         inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
         printf("Accepted connection from %s:%d on socket %d\n", client_ip, ntohs(client_addr.sin_port), client_sockfd);
 
+        ClientConnection *conn = malloc(sizeof(ClientConnection));
+        if (conn == NULL) {
+            perror("malloc failed");
+            close(client_sockfd);
+            continue;
+        }
+        conn->sockfd = client_sockfd;
+        conn->accept_ns = accept_ns;
+
         pthread_t thread_id;
-        if (pthread_create(&thread_id, NULL, client_handler_thread, (void *)(intptr_t)client_sockfd) != 0) {
+        if (pthread_create(&thread_id, NULL, client_handler_thread, conn) != 0) {
             perror("pthread_create failed");
+            free(conn);
             close(client_sockfd);
         }
     }
@@ -145,6 +203,7 @@ int main(int argc, char *argv[]) {
     if (server_fd != -1) {
         close(server_fd);
     }
+    trace_close_file();
     printf("Server shutdown complete.\n");
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,717 @@
+#define _GNU_SOURCE
+
+#include "proxy.h"
+#include "response.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <poll.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define PROXY_MAX_PREFIX_LEN 256
+#define PROXY_MAX_SPEC_LEN 256
+#define PROXY_POOL_SIZE 8
+#define PROXY_BUFFER_SIZE 16384
+#define PROXY_SPLICE_CHUNK 65536
+#define PROXY_CONNECT_TIMEOUT_MS 1000
+#define PROXY_IO_TIMEOUT_SEC 30
+#define PROXY_HEALTH_INTERVAL_SEC 5
+
+typedef enum {
+    BALANCE_ROUND_ROBIN,
+    BALANCE_LEAST_CONN
+} BalanceMode;
+
+typedef struct {
+    char spec[PROXY_MAX_SPEC_LEN];
+    char host_header[PROXY_MAX_SPEC_LEN];
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+
+    pthread_mutex_t lock;
+    int idle_fds[PROXY_POOL_SIZE];
+    int idle_count;
+
+    atomic_int active;
+    atomic_int healthy;
+} Upstream;
+
+// Buffered reader over an upstream socket; unread bytes stay in the socket for splice().
+typedef struct {
+    int fd;
+    char buf[PROXY_BUFFER_SIZE];
+    size_t pos;
+    size_t len;
+} UpstreamReader;
+
+typedef struct {
+    int status_code;
+    int chunked;
+    int keep_alive;
+    long long content_length;
+} UpstreamResponse;
+
+static char proxy_prefix[PROXY_MAX_PREFIX_LEN];
+static size_t proxy_prefix_len = 0;
+static Upstream upstreams[PROXY_MAX_UPSTREAMS];
+static int upstream_count = 0;
+static BalanceMode balance_mode = BALANCE_ROUND_ROBIN;
+static atomic_uint round_robin_next;
+
+// Set the URI prefix routed to upstreams, e.g. "/api/". A trailing slash is ignored.
+int proxy_set_prefix(const char *prefix) {
+    size_t len = strlen(prefix);
+    while (len > 1 && prefix[len - 1] == '/') {
+        len--;
+    }
+    if (prefix[0] != '/' || len >= sizeof(proxy_prefix)) {
+        fprintf(stderr, "Invalid proxy prefix: %s\n", prefix);
+        return -1;
+    }
+    memcpy(proxy_prefix, prefix, len);
+    proxy_prefix[len] = '\0';
+    proxy_prefix_len = len;
+    return 0;
+}
+
+// Add an upstream given as "host:port", "tcp:host:port" or "unix:/path/to/socket".
+int proxy_add_upstream(const char *spec) {
+    if (upstream_count >= PROXY_MAX_UPSTREAMS) {
+        fprintf(stderr, "Too many upstreams (max %d).\n", PROXY_MAX_UPSTREAMS);
+        return -1;
+    }
+    if (strlen(spec) >= PROXY_MAX_SPEC_LEN) {
+        fprintf(stderr, "Upstream address too long: %s\n", spec);
+        return -1;
+    }
+
+    Upstream *u = &upstreams[upstream_count];
+    memset(u, 0, sizeof(*u));
+    strcpy(u->spec, spec);
+
+    if (strncmp(spec, "unix:", 5) == 0) {
+        struct sockaddr_un *sun = (struct sockaddr_un *)&u->addr;
+        const char *path = spec + 5;
+        if (*path == '\0' || strlen(path) >= sizeof(sun->sun_path)) {
+            fprintf(stderr, "Invalid unix socket path: %s\n", spec);
+            return -1;
+        }
+        sun->sun_family = AF_UNIX;
+        strcpy(sun->sun_path, path);
+        u->addr_len = sizeof(struct sockaddr_un);
+        strcpy(u->host_header, "localhost");
+    } else {
+        char host[PROXY_MAX_SPEC_LEN];
+        strcpy(host, strncmp(spec, "tcp:", 4) == 0 ? spec + 4 : spec);
+        strcpy(u->host_header, host);
+
+        char *colon = strrchr(host, ':');
+        if (colon == NULL || colon == host || colon[1] == '\0') {
+            fprintf(stderr, "Invalid upstream address (expected host:port): %s\n", spec);
+            return -1;
+        }
+        *colon = '\0';
+
+        struct addrinfo hints = {0};
+        struct addrinfo *res;
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        int rc = getaddrinfo(host, colon + 1, &hints, &res);
+        if (rc != 0) {
+            fprintf(stderr, "Cannot resolve upstream %s: %s\n", spec, gai_strerror(rc));
+            return -1;
+        }
+        memcpy(&u->addr, res->ai_addr, res->ai_addrlen);
+        u->addr_len = res->ai_addrlen;
+        freeaddrinfo(res);
+    }
+
+    pthread_mutex_init(&u->lock, NULL);
+    atomic_init(&u->active, 0);
+    atomic_init(&u->healthy, 1);
+    upstream_count++;
+    return 0;
+}
+
+// Select the balancing strategy: "rr" (round-robin) or "lc" (least connections).
+int proxy_set_balance(const char *name) {
+    if (strcmp(name, "rr") == 0) {
+        balance_mode = BALANCE_ROUND_ROBIN;
+    } else if (strcmp(name, "lc") == 0) {
+        balance_mode = BALANCE_LEAST_CONN;
+    } else {
+        fprintf(stderr, "Invalid balance mode: %s (use rr or lc)\n", name);
+        return -1;
+    }
+    return 0;
+}
+
+// Return non-zero if the URI falls under the configured proxy prefix.
+int proxy_matches(const char *uri) {
+    if (proxy_prefix_len == 0 || upstream_count == 0) return 0;
+    if (strncmp(uri, proxy_prefix, proxy_prefix_len) != 0) return 0;
+    if (proxy_prefix_len == 1) return 1;
+
+    char next = uri[proxy_prefix_len];
+    return next == '\0' || next == '/' || next == '?';
+}
+
+// Update an upstream's health flag, logging transitions. Idle connections to an
+// upstream that went down are closed rather than handed out later.
+static void set_upstream_health(Upstream *u, int healthy) {
+    int was_healthy = atomic_exchange(&u->healthy, healthy);
+    if (was_healthy == healthy) return;
+
+    fprintf(stderr, "Upstream %s is %s.\n", u->spec, healthy ? "up" : "down");
+    if (!healthy) {
+        pthread_mutex_lock(&u->lock);
+        while (u->idle_count > 0) {
+            close(u->idle_fds[--u->idle_count]);
+        }
+        pthread_mutex_unlock(&u->lock);
+    }
+}
+
+// Open a new connection to an upstream with a bounded connect time.
+static int connect_upstream(Upstream *u) {
+    int fd = socket(u->addr.ss_family, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        perror("socket upstream");
+        return -1;
+    }
+
+    if (connect(fd, (struct sockaddr *)&u->addr, u->addr_len) < 0) {
+        if (errno != EINPROGRESS) {
+            close(fd);
+            return -1;
+        }
+        struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+        int err = 0;
+        socklen_t err_len = sizeof(err);
+        if (poll(&pfd, 1, PROXY_CONNECT_TIMEOUT_MS) <= 0 ||
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len) < 0 || err != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+
+    struct timeval tv = { .tv_sec = PROXY_IO_TIMEOUT_SEC, .tv_usec = 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    if (u->addr.ss_family != AF_UNIX) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+// Periodically probe every upstream with a fresh connection.
+static void *health_check_thread(void *arg) {
+    (void)arg;
+    while (1) {
+        sleep(PROXY_HEALTH_INTERVAL_SEC);
+        for (int i = 0; i < upstream_count; i++) {
+            int fd = connect_upstream(&upstreams[i]);
+            set_upstream_health(&upstreams[i], fd >= 0);
+            if (fd >= 0) close(fd);
+        }
+    }
+    return NULL;
+}
+
+// Start background health checks. Call once after all upstreams are added.
+int proxy_start(void) {
+    if (proxy_prefix_len == 0 && upstream_count == 0) return 0;
+    if (proxy_prefix_len == 0 || upstream_count == 0) {
+        fprintf(stderr, "Proxy needs both a prefix (-x) and at least one upstream (-u).\n");
+        return -1;
+    }
+
+    pthread_t thread_id;
+    if (pthread_create(&thread_id, NULL, health_check_thread, NULL) != 0) {
+        perror("pthread_create health check");
+        return -1;
+    }
+    pthread_detach(thread_id);
+
+    printf("Proxying %s/ to %d upstream(s) (%s).\n", proxy_prefix, upstream_count,
+           balance_mode == BALANCE_LEAST_CONN ? "least connections" : "round-robin");
+    return 0;
+}
+
+// Pick an upstream according to the balancing mode, skipping down ones unless include_down.
+static Upstream *choose_upstream(int include_down) {
+    if (balance_mode == BALANCE_LEAST_CONN) {
+        Upstream *best = NULL;
+        int best_active = 0;
+        for (int i = 0; i < upstream_count; i++) {
+            Upstream *u = &upstreams[i];
+            if (!include_down && !atomic_load(&u->healthy)) continue;
+            int active = atomic_load(&u->active);
+            if (best == NULL || active < best_active) {
+                best = u;
+                best_active = active;
+            }
+        }
+        return best;
+    }
+
+    unsigned start = atomic_fetch_add(&round_robin_next, 1);
+    for (int i = 0; i < upstream_count; i++) {
+        Upstream *u = &upstreams[(start + i) % upstream_count];
+        if (include_down || atomic_load(&u->healthy)) return u;
+    }
+    return NULL;
+}
+
+// Check that an idle pooled connection has not been closed by the upstream.
+static int idle_connection_alive(int fd) {
+    char c;
+    ssize_t n = recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+// Take a pooled keep-alive connection if allowed, or open a new one. Sets *reused accordingly.
+static int acquire_connection(Upstream *u, int allow_pooled, int *reused) {
+    int fd = -1;
+
+    pthread_mutex_lock(&u->lock);
+    while (allow_pooled && u->idle_count > 0 && fd < 0) {
+        fd = u->idle_fds[--u->idle_count];
+        if (!idle_connection_alive(fd)) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    pthread_mutex_unlock(&u->lock);
+
+    *reused = fd >= 0;
+    if (fd < 0) {
+        fd = connect_upstream(u);
+        set_upstream_health(u, fd >= 0);
+    }
+    return fd;
+}
+
+// Return a connection to the pool if it can carry another request, else close it.
+static void release_connection(Upstream *u, int fd, int reusable) {
+    if (reusable) {
+        pthread_mutex_lock(&u->lock);
+        if (u->idle_count < PROXY_POOL_SIZE) {
+            u->idle_fds[u->idle_count++] = fd;
+            fd = -1;
+        }
+        pthread_mutex_unlock(&u->lock);
+    }
+    if (fd >= 0) close(fd);
+}
+
+// Append formatted text to a buffer, tracking overflow through *len.
+static void buf_append(char *buf, size_t size, int *len, const char *fmt, ...) {
+    if (*len < 0 || (size_t)*len >= size) {
+        *len = -1;
+        return;
+    }
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf + *len, size - *len, fmt, args);
+    va_end(args);
+    *len = (n < 0 || (size_t)n >= size - *len) ? -1 : *len + n;
+}
+
+// Headers that apply to a single connection and must not be forwarded.
+static int is_hop_by_hop_header(const char *name) {
+    return strcasecmp(name, "Connection") == 0 ||
+           strcasecmp(name, "Keep-Alive") == 0 ||
+           strcasecmp(name, "Proxy-Connection") == 0 ||
+           strcasecmp(name, "TE") == 0 ||
+           strcasecmp(name, "Upgrade") == 0;
+}
+
+// Return non-zero if name appears in a comma-separated Connection header value.
+static int connection_lists_header(const char *connection, const char *name) {
+    size_t name_len = strlen(name);
+    const char *p = connection;
+    while (p && *p) {
+        while (*p == ' ' || *p == '\t' || *p == ',') p++;
+        const char *end = strchr(p, ',');
+        size_t token_len = end ? (size_t)(end - p) : strlen(p);
+        while (token_len > 0 && (p[token_len - 1] == ' ' || p[token_len - 1] == '\t')) token_len--;
+        if (token_len == name_len && strncasecmp(p, name, name_len) == 0) return 1;
+        p = end;
+    }
+    return 0;
+}
+
+// Request headers that must not reach the upstream. The request body is never
+// read or forwarded, so its framing headers and Expect are dropped too.
+static int is_dropped_request_header(const HttpRequest *req, const char *name) {
+    if (is_hop_by_hop_header(name) ||
+        strcasecmp(name, "Content-Length") == 0 ||
+        strcasecmp(name, "Transfer-Encoding") == 0 ||
+        strcasecmp(name, "Expect") == 0) {
+        return 1;
+    }
+    const char *connection = get_request_header(req, "Connection");
+    return connection && connection_lists_header(connection, name);
+}
+
+// Build the upstream request line and headers, stripping the proxy prefix from the URI.
+static int build_upstream_request(const HttpRequest *req, const Upstream *u, char *buf, size_t size) {
+    const char *path = req->uri + proxy_prefix_len;
+    if (proxy_prefix_len == 1) path = req->uri;
+    int len = 0;
+
+    buf_append(buf, size, &len, "%s %s%s HTTP/1.1\r\n", req->method, path[0] == '/' ? "" : "/", path);
+
+    for (int i = 0; i < req->header_count; i++) {
+        if (is_dropped_request_header(req, req->headers[i].name)) continue;
+        buf_append(buf, size, &len, "%s: %s\r\n", req->headers[i].name, req->headers[i].value);
+    }
+    if (get_request_header(req, "Host") == NULL) {
+        buf_append(buf, size, &len, "Host: %s\r\n", u->host_header);
+    }
+    buf_append(buf, size, &len, "Connection: keep-alive\r\n\r\n");
+    return len;
+}
+
+// Read more upstream data into the reader, compacting consumed bytes first.
+static ssize_t reader_fill(UpstreamReader *r) {
+    if (r->pos > 0) {
+        memmove(r->buf, r->buf + r->pos, r->len - r->pos);
+        r->len -= r->pos;
+        r->pos = 0;
+    }
+    if (r->len >= sizeof(r->buf) - 1) return -1;
+
+    ssize_t n;
+    do {
+        n = recv(r->fd, r->buf + r->len, sizeof(r->buf) - 1 - r->len, 0);
+    } while (n < 0 && errno == EINTR);
+    if (n > 0) {
+        r->len += n;
+        r->buf[r->len] = '\0';
+    }
+    return n;
+}
+
+// Read one CRLF-terminated line; returns its length including the CRLF, or -1.
+static ssize_t reader_line(UpstreamReader *r, const char **line) {
+    while (1) {
+        char *nl = memchr(r->buf + r->pos, '\n', r->len - r->pos);
+        if (nl) {
+            *line = r->buf + r->pos;
+            size_t line_len = nl - *line + 1;
+            r->pos += line_len;
+            return line_len;
+        }
+        if (reader_fill(r) <= 0) return -1;
+    }
+}
+
+// Move exactly n bytes (or until EOF if n < 0) from the upstream to the client.
+// Already-buffered bytes are sent first, the rest is spliced through a pipe.
+static int relay_body(UpstreamReader *r, int pipefd[2], int client_fd, long long n) {
+    size_t buffered = r->len - r->pos;
+    if (n >= 0 && (long long)buffered > n) buffered = n;
+    if (buffered > 0) {
+        if (send_all(client_fd, r->buf + r->pos, buffered) < 0) return -1;
+        r->pos += buffered;
+        if (n >= 0) n -= buffered;
+    }
+
+    while (n != 0) {
+        size_t want = (n < 0 || n > PROXY_SPLICE_CHUNK) ? PROXY_SPLICE_CHUNK : (size_t)n;
+        ssize_t in = splice(r->fd, NULL, pipefd[1], NULL, want, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (in < 0) {
+            if (errno == EINTR) continue;
+            perror("splice from upstream");
+            return -1;
+        }
+        if (in == 0) {
+            if (n < 0) return 0;
+            fprintf(stderr, "Upstream closed connection mid-body.\n");
+            return -1;
+        }
+
+        ssize_t pending = in;
+        while (pending > 0) {
+            ssize_t out = splice(pipefd[0], NULL, client_fd, NULL, pending, SPLICE_F_MOVE | SPLICE_F_MORE);
+            if (out < 0) {
+                if (errno == EINTR) continue;
+                perror("splice to client");
+                return -1;
+            }
+            pending -= out;
+        }
+        if (n > 0) n -= in;
+    }
+    return 0;
+}
+
+// Relay a chunked body, using the chunk framing to find where it ends. With dechunk
+// set (HTTP/1.0 clients), only the chunk data is sent and the framing is dropped.
+static int relay_chunked_body(UpstreamReader *r, int pipefd[2], int client_fd, int dechunk) {
+    const char *line;
+    ssize_t line_len;
+
+    while (1) {
+        line_len = reader_line(r, &line);
+        if (line_len < 0) return -1;
+        char *end;
+        long long chunk_size = strtoll(line, &end, 16);
+        if (end == line || chunk_size < 0 || chunk_size > LLONG_MAX - 2) {
+            fprintf(stderr, "Malformed chunk size from upstream.\n");
+            return -1;
+        }
+        if (!dechunk && send_all(client_fd, line, line_len) < 0) return -1;
+
+        if (chunk_size == 0) break;
+        if (dechunk) {
+            if (relay_body(r, pipefd, client_fd, chunk_size) < 0) return -1;
+            line_len = reader_line(r, &line);
+            if (line_len < 0 || (line[0] != '\r' && line[0] != '\n')) {
+                fprintf(stderr, "Malformed chunk terminator from upstream.\n");
+                return -1;
+            }
+        } else if (relay_body(r, pipefd, client_fd, chunk_size + 2) < 0) {
+            return -1;
+        }
+    }
+
+    // Trailer section ends with an empty line.
+    do {
+        line_len = reader_line(r, &line);
+        if (line_len < 0) return -1;
+        if (!dechunk && send_all(client_fd, line, line_len) < 0) return -1;
+    } while (line[0] != '\r' && line[0] != '\n');
+    return 0;
+}
+
+// Parse a Content-Length value: digits only, optionally followed by whitespace.
+static int parse_content_length(const char *value, long long *out) {
+    if (!isdigit((unsigned char)*value)) return -1;
+
+    char *end;
+    errno = 0;
+    long long length = strtoll(value, &end, 10);
+    while (*end == ' ' || *end == '\t') end++;
+    if (errno == ERANGE || *end != '\0') return -1;
+
+    *out = length;
+    return 0;
+}
+
+// Read and parse the upstream status line and headers, and build the client-facing header.
+// With dechunk set, Transfer-Encoding is left out because the body will be sent unframed.
+// Interim 1xx responses are skipped; only the final response is parsed.
+// Returns 0 on success, -2 if the connection closed or reset before any data, -1 otherwise.
+static int read_upstream_header(UpstreamReader *r, UpstreamResponse *resp, int dechunk,
+                                char *out, size_t out_size, int *out_len) {
+    char *head;
+    char version[16];
+    int got_interim = 0;
+
+    while (1) {
+        char *header_end;
+        while ((header_end = strstr(r->buf + r->pos, "\r\n\r\n")) == NULL) {
+            ssize_t n = reader_fill(r);
+            // A timeout means the upstream is slow, not that the connection was stale.
+            if (r->len == 0 && !got_interim &&
+                (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))) return -2;
+            if (n <= 0) return -1;
+        }
+        head = r->buf + r->pos;
+        r->pos = header_end + 4 - r->buf;
+        header_end[2] = '\0';
+
+        if (sscanf(head, "%15s %d", version, &resp->status_code) != 2 ||
+            strncmp(version, "HTTP/1.", 7) != 0) {
+            fprintf(stderr, "Malformed upstream status line.\n");
+            return -1;
+        }
+        if (resp->status_code >= 200) break;
+        got_interim = 1;
+    }
+
+    resp->keep_alive = strcmp(version, "HTTP/1.0") != 0;
+    resp->chunked = 0;
+    resp->content_length = -1;
+
+    char *line = head;
+    char *eol = strstr(line, "\r\n");
+    *eol = '\0';
+    int len = 0;
+    buf_append(out, out_size, &len, "%s\r\n", line);
+
+    for (line = eol + 2; *line; line = eol + 2) {
+        eol = strstr(line, "\r\n");
+        *eol = '\0';
+
+        char *colon = strchr(line, ':');
+        if (colon == NULL) continue;
+        *colon = '\0';
+        char *value = colon + 1;
+        while (*value == ' ' || *value == '\t') value++;
+
+        if (strcasecmp(line, "Content-Length") == 0) {
+            // Bad or conflicting lengths make the body boundary unknowable; fail before
+            // anything reaches the client.
+            long long length;
+            if (parse_content_length(value, &length) < 0 ||
+                (resp->content_length >= 0 && resp->content_length != length)) {
+                fprintf(stderr, "Invalid Content-Length from upstream: %s\n", value);
+                return -1;
+            }
+            resp->content_length = length;
+        } else if (strcasecmp(line, "Transfer-Encoding") == 0 && strcasestr(value, "chunked")) {
+            resp->chunked = 1;
+        } else if (strcasecmp(line, "Connection") == 0) {
+            if (strcasestr(value, "close")) resp->keep_alive = 0;
+            if (strcasestr(value, "keep-alive")) resp->keep_alive = 1;
+        }
+
+        if (is_hop_by_hop_header(line)) continue;
+        if (dechunk && strcasecmp(line, "Transfer-Encoding") == 0) continue;
+        buf_append(out, out_size, &len, "%s: %s\r\n", line, value);
+    }
+
+    char timing_buf[256];
+    trace_format_server_timing(timing_buf, sizeof(timing_buf));
+    buf_append(out, out_size, &len, "Connection: close\r\n%s\r\n", timing_buf);
+    if (len < 0) {
+        fprintf(stderr, "Upstream response header too large.\n");
+        return -1;
+    }
+    *out_len = len;
+    return 0;
+}
+
+// Forward one request to an upstream and stream the response back to the client.
+// Returns 0 if the response was relayed, -2 if a reused connection turned out stale
+// before any response data arrived (safe to retry), -1 on any other failure.
+static int proxy_exchange(int upstream_fd, int reused, const char *request, int request_len,
+                          int client_fd, int client_http10, int *header_sent, int *reusable) {
+    UpstreamReader reader;
+    UpstreamResponse resp;
+    char client_header[PROXY_BUFFER_SIZE];
+    int client_header_len = 0;
+
+    *reusable = 0;
+    reader.fd = upstream_fd;
+    reader.pos = 0;
+    reader.len = 0;
+    reader.buf[0] = '\0';
+
+    if (send_all(upstream_fd, request, request_len) < 0) {
+        return reused ? -2 : -1;
+    }
+
+    errno = 0;
+    int rc = read_upstream_header(&reader, &resp, client_http10, client_header, sizeof(client_header), &client_header_len);
+    if (rc == -2 && reused) return -2;
+    if (rc < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            send_error_response(client_fd, 504, "Gateway Timeout", "Upstream did not respond in time.");
+        } else {
+            send_error_response(client_fd, 502, "Bad Gateway", "Invalid response from upstream.");
+        }
+        *header_sent = 1;
+        return -1;
+    }
+
+    if (send_all(client_fd, client_header, client_header_len) < 0) {
+        *header_sent = 1;
+        return -1;
+    }
+    *header_sent = 1;
+    trace_set_status(resp.status_code);
+    trace_mark(TRACE_HEADER_SENT);
+
+    if (resp.status_code < 200 || resp.status_code == 204 || resp.status_code == 304) {
+        *reusable = resp.keep_alive;
+        return 0;
+    }
+
+    int pipefd[2];
+    if (pipe2(pipefd, O_CLOEXEC) < 0) {
+        perror("pipe2");
+        return -1;
+    }
+
+    if (resp.chunked) {
+        // HTTP/1.0 clients cannot decode chunked bodies; they read until close instead.
+        rc = relay_chunked_body(&reader, pipefd, client_fd, client_http10);
+    } else if (resp.content_length >= 0) {
+        rc = relay_body(&reader, pipefd, client_fd, resp.content_length);
+    } else {
+        resp.keep_alive = 0;
+        rc = relay_body(&reader, pipefd, client_fd, -1);
+    }
+
+    close(pipefd[0]);
+    close(pipefd[1]);
+
+    // Leftover bytes mean the upstream sent more than it framed; do not reuse.
+    *reusable = rc == 0 && resp.keep_alive && reader.pos == reader.len;
+    return rc;
+}
+
+// Handle requests under the configured proxy prefix by forwarding them to an upstream.
+void handle_proxy_request(int sockfd, const HttpRequest *req) {
+    // With every upstream marked down, try one anyway instead of waiting for the
+    // next health probe; a successful connect marks it up again.
+    Upstream *u = choose_upstream(0);
+    if (u == NULL) {
+        u = choose_upstream(1);
+    }
+
+    char request_buf[PROXY_BUFFER_SIZE];
+    int request_len = build_upstream_request(req, u, request_buf, sizeof(request_buf));
+    if (request_len < 0) {
+        send_error_response(sockfd, 431, "Request Header Fields Too Large", "Request headers too large to proxy.");
+        return;
+    }
+
+    atomic_fetch_add(&u->active, 1);
+
+    int client_http10 = strcmp(req->version, "HTTP/1.0") == 0;
+    int header_sent = 0;
+    int rc = -1;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        int reused;
+        int reusable;
+        int upstream_fd = acquire_connection(u, attempt == 0, &reused);
+        if (upstream_fd < 0) break;
+
+        rc = proxy_exchange(upstream_fd, reused, request_buf, request_len, sockfd, client_http10,
+                            &header_sent, &reusable);
+        release_connection(u, upstream_fd, reusable);
+
+        // A stale pooled connection is retried once on a fresh one.
+        if (rc != -2) break;
+    }
+
+    atomic_fetch_sub(&u->active, 1);
+
+    if (rc != 0 && !header_sent) {
+        send_error_response(sockfd, 502, "Bad Gateway", "Could not connect to upstream.");
+    }
+}
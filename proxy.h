@@ -0,0 +1,20 @@
+#ifndef PROXY_H
+#define PROXY_H
+
+#include "request.h"
+
+#define PROXY_MAX_UPSTREAMS 16
+
+int proxy_set_prefix(const char *prefix);
+
+int proxy_add_upstream(const char *spec);
+
+int proxy_set_balance(const char *name);
+
+int proxy_start(void);
+
+int proxy_matches(const char *uri);
+
+void handle_proxy_request(int sockfd, const HttpRequest *req);
+
+#endif
@@ -1,6 +1,7 @@
 #define _GNU_SOURCE
 
 #include "request.h"
+#include "trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -21,6 +22,7 @@ ssize_t read_line(int sockfd, char *buf, size_t size) {
     while (i < size - 1 && c != '\n') {
         n = recv(sockfd, &c, 1, 0);
         if (n > 0) {
+            trace_mark_once(TRACE_FIRST_BYTE);
             if (c == '\r') {
                 n = recv(sockfd, &c, 1, MSG_PEEK);
                 if (n > 0 && c == '\n') {
@@ -110,6 +112,8 @@ int parse_request(int sockfd, HttpRequest *req) {
         fprintf(stderr, "Warning: Too many headers received (max %d).\n", MAX_HEADERS);
     }
 
+    trace_mark(TRACE_HEADERS_PARSED);
+
     return 0;
 }
 
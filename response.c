@@ -1,4 +1,5 @@
 #include "response.h"
+#include "trace.h"
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
@@ -34,10 +35,12 @@ ssize_t send_all(int sockfd, const char *buf, size_t len) {
 int send_response_header(int sockfd, const HttpResponseInfo *info) {
     char header_buf[WRITE_BUFFER_SIZE];
     char time_buf[128];
+    char timing_buf[256];
     time_t now = time(0);
     struct tm *tm = gmtime(&now);
 
     strftime(time_buf, sizeof(time_buf), "%a, %d %b %Y %H:%M:%S GMT", tm);
+    trace_format_server_timing(timing_buf, sizeof(timing_buf));
 
     int len = snprintf(header_buf, sizeof(header_buf),
                        "HTTP/1.1 %d %s\r\n"
@@ -47,12 +50,14 @@ int send_response_header(int sockfd, const HttpResponseInfo *info) {
                        "Content-Length: %ld\r\n"
                        "Connection: close\r\n"
                        "%s"
+                       "%s"
                        "\r\n",
                        info->status_code, info->status_message,
                        time_buf,
                        info->content_type[0] ? info->content_type : "application/octet-stream",
                        (long)info->content_length,
-                       info->additional_headers ? info->additional_headers : ""
+                       info->additional_headers ? info->additional_headers : "",
+                       timing_buf
                        );
 
     if (len < 0 || (size_t)len >= sizeof(header_buf)) {
@@ -64,6 +69,8 @@ int send_response_header(int sockfd, const HttpResponseInfo *info) {
         return -1;
     }
 
+    trace_set_status(info->status_code);
+    trace_mark(TRACE_HEADER_SENT);
     return 0;
 }
 
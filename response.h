@@ -13,6 +13,8 @@ typedef struct {
     char additional_headers[1024];
 } HttpResponseInfo;
 
+ssize_t send_all(int sockfd, const char *buf, size_t len);
+
 int send_response_header(int sockfd, const HttpResponseInfo *info);
 
 int send_response_body(int sockfd, const char *body);
@@ -0,0 +1,277 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define BACKEND_BUFFER_SIZE 8192
+#define BIG_BODY_SIZE 1000000
+#define EOF_BODY_SIZE 200000
+
+static const char *backend_name;
+static atomic_int next_conn_id = 1;
+
+typedef struct {
+    int sockfd;
+    int conn_id;
+} BackendConnection;
+
+// Send a whole buffer, returning -1 on failure.
+static int send_all(int sockfd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(sockfd, buf, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Send n copies of byte c.
+static int send_fill(int sockfd, char c, size_t n) {
+    char buf[BACKEND_BUFFER_SIZE];
+    memset(buf, c, sizeof(buf));
+    while (n > 0) {
+        size_t len = n < sizeof(buf) ? n : sizeof(buf);
+        if (send_all(sockfd, buf, len) < 0) return -1;
+        n -= len;
+    }
+    return 0;
+}
+
+// Find a header value in a raw request head (case-insensitive name); copies it to out.
+static int find_header(const char *head, const char *name, char *out, size_t out_size) {
+    size_t name_len = strlen(name);
+    for (const char *line = strstr(head, "\r\n"); line; line = strstr(line, "\r\n")) {
+        line += 2;
+        if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+            const char *value = line + name_len + 1;
+            while (*value == ' ') value++;
+            size_t len = strcspn(value, "\r\n");
+            if (len >= out_size) len = out_size - 1;
+            memcpy(out, value, len);
+            out[len] = '\0';
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Close with a TCP RST (or a plain close on Unix sockets), like a crashed or recycled backend.
+static void reset_connection(int sockfd) {
+    struct linger lg = { .l_onoff = 1, .l_linger = 0 };
+    setsockopt(sockfd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    close(sockfd);
+}
+
+// Serve keep-alive HTTP/1.1 requests on one connection until the peer closes.
+static void *connection_thread(void *arg) {
+    BackendConnection *conn = arg;
+    int sockfd = conn->sockfd;
+    int conn_id = conn->conn_id;
+    free(conn);
+
+    char buf[BACKEND_BUFFER_SIZE + 1];
+    size_t len = 0;
+    int request_count = 0;
+    int drop_next = 0;
+
+    while (1) {
+        char *head_end;
+        buf[len] = '\0';
+        while ((head_end = strstr(buf, "\r\n\r\n")) == NULL) {
+            if (len >= BACKEND_BUFFER_SIZE) goto done;
+            ssize_t n = recv(sockfd, buf + len, BACKEND_BUFFER_SIZE - len, 0);
+            if (n <= 0) goto done;
+            len += n;
+            buf[len] = '\0';
+        }
+        *head_end = '\0';
+        size_t consumed = head_end + 4 - buf;
+        request_count++;
+
+        if (drop_next) {
+            reset_connection(sockfd);
+            return NULL;
+        }
+
+        char method[16] = "";
+        char path[2048] = "";
+        char version[16] = "";
+        sscanf(buf, "%15s %2047s %15s", method, path, version);
+
+        // Honour a request body, as a real backend would.
+        char value[256];
+        if (find_header(buf, "Content-Length", value, sizeof(value))) {
+            size_t body_len = strtoul(value, NULL, 10);
+            while (len - consumed < body_len) {
+                ssize_t n = recv(sockfd, buf + len, BACKEND_BUFFER_SIZE - len, 0);
+                if (n <= 0) goto done;
+                len += n;
+            }
+            consumed += body_len;
+        }
+
+        int keep_alive = strcmp(version, "HTTP/1.0") != 0;
+        if (find_header(buf, "Connection", value, sizeof(value))) {
+            if (strcasecmp(value, "close") == 0) keep_alive = 0;
+        }
+
+        char body[BACKEND_BUFFER_SIZE + 64];
+        char header[512];
+        int rc = 0;
+
+        if (strncmp(path, "/slow", 5) == 0) {
+            sleep(1);
+        }
+
+        if (strncmp(path, "/chunked", 8) == 0) {
+            snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"
+                                             "Transfer-Encoding: chunked\r\n\r\n");
+            rc = send_all(sockfd, header, strlen(header));
+            const char *parts[] = { "hello ", "chunked ", "world\n" };
+            for (int i = 0; i < 3 && rc == 0; i++) {
+                snprintf(body, sizeof(body), "%zx\r\n%s\r\n", strlen(parts[i]), parts[i]);
+                rc = send_all(sockfd, body, strlen(body));
+            }
+            if (rc == 0) rc = send_all(sockfd, "0\r\n\r\n", 5);
+        } else if (strncmp(path, "/eof", 4) == 0) {
+            snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"
+                                             "Connection: close\r\n\r\n");
+            if (send_all(sockfd, header, strlen(header)) == 0) send_fill(sockfd, 'e', EOF_BODY_SIZE);
+            goto done;
+        } else if (strncmp(path, "/bad-length/", 12) == 0) {
+            // Malformed or conflicting Content-Length headers, then close.
+            const char *kind = path + 12;
+            const char *lengths = strcmp(kind, "negative") == 0 ? "Content-Length: -1\r\n"
+                                : strcmp(kind, "garbage") == 0 ? "Content-Length: 3abc\r\n"
+                                : strcmp(kind, "empty") == 0 ? "Content-Length: \r\n"
+                                : strcmp(kind, "conflict") == 0 ? "Content-Length: 3\r\nContent-Length: 4\r\n"
+                                : "Content-Length: 3\r\nContent-Length: 3\r\n";
+            snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n%s\r\nok\n", lengths);
+            send_all(sockfd, header, strlen(header));
+            goto done;
+        } else if (strncmp(path, "/big", 4) == 0) {
+            snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"
+                                             "Content-Length: %d\r\n\r\n", BIG_BODY_SIZE);
+            rc = send_all(sockfd, header, strlen(header));
+            if (rc == 0) rc = send_fill(sockfd, 'b', BIG_BODY_SIZE);
+        } else {
+            // Send an interim 103 Early Hints before the final response.
+            if (strncmp(path, "/early-hints", 12) == 0) {
+                const char *hints = "HTTP/1.1 103 Early Hints\r\nLink: </style.css>; rel=preload\r\n\r\n";
+                if (send_all(sockfd, hints, strlen(hints)) < 0) goto done;
+            }
+            if (strncmp(path, "/echo-headers", 13) == 0) {
+                snprintf(body, sizeof(body), "%s\n", buf);
+            } else {
+                snprintf(body, sizeof(body), "%s path=%s conn=%d req=%d\n",
+                         backend_name, path, conn_id, request_count);
+            }
+            // After answering /drop-next, reset the connection on its next request.
+            if (strncmp(path, "/drop-next", 10) == 0) drop_next = 1;
+
+            snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"
+                                             "Content-Length: %zu\r\n%s\r\n",
+                     strlen(body), keep_alive ? "" : "Connection: close\r\n");
+            rc = send_all(sockfd, header, strlen(header));
+            if (rc == 0) rc = send_all(sockfd, body, strlen(body));
+        }
+
+        if (rc < 0 || !keep_alive) goto done;
+
+        memmove(buf, buf + consumed, len - consumed);
+        len -= consumed;
+    }
+
+done:
+    close(sockfd);
+    return NULL;
+}
+
+// Listen on a TCP port or "unix:/path" and serve each connection on its own thread.
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <port|unix:/path> <name>\n", argv[0]);
+        return 1;
+    }
+    backend_name = argv[2];
+    signal(SIGPIPE, SIG_IGN);
+
+    int sockfd;
+    if (strncmp(argv[1], "unix:", 5) == 0) {
+        struct sockaddr_un addr = {0};
+        const char *path = argv[1] + 5;
+        if (strlen(path) >= sizeof(addr.sun_path)) {
+            fprintf(stderr, "Unix socket path too long: %s\n", path);
+            return 1;
+        }
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, path);
+        unlink(path);
+
+        sockfd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (sockfd < 0 || bind(sockfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+            perror("bind unix socket");
+            return 1;
+        }
+    } else {
+        struct sockaddr_in addr = {0};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(atoi(argv[1]));
+
+        sockfd = socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        if (sockfd < 0 ||
+            setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0 ||
+            bind(sockfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+            perror("bind tcp socket");
+            return 1;
+        }
+    }
+
+    if (listen(sockfd, 64) < 0) {
+        perror("listen");
+        return 1;
+    }
+
+    while (1) {
+        int client_sockfd = accept(sockfd, NULL, NULL);
+        if (client_sockfd < 0) {
+            if (errno == EINTR) continue;
+            perror("accept");
+            return 1;
+        }
+
+        BackendConnection *conn = malloc(sizeof(BackendConnection));
+        if (conn == NULL) {
+            close(client_sockfd);
+            continue;
+        }
+        conn->sockfd = client_sockfd;
+        conn->conn_id = atomic_fetch_add(&next_conn_id, 1);
+
+        pthread_t thread_id;
+        if (pthread_create(&thread_id, NULL, connection_thread, conn) != 0) {
+            free(conn);
+            close(client_sockfd);
+            continue;
+        }
+        pthread_detach(thread_id);
+    }
+}
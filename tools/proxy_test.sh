@@ -0,0 +1,181 @@
+#!/bin/bash
+# Exercise the reverse-proxy route against local proxy_backend instances.
+# Run from the repository root after `make` (or via `make check`).
+
+set -u
+
+BASE_PORT=${PROXY_TEST_PORT:-18480}
+BACKEND_PORT=$BASE_PORT
+SOCK=/tmp/proxy_test_backend.$$.sock
+WORK=$(mktemp -d)
+
+SERVER=./http_server
+BACKEND=./proxy_backend
+
+PIDS=()
+FAILED=0
+PASSED=0
+
+cleanup() {
+    for pid in "${PIDS[@]}"; do
+        kill "$pid" 2>/dev/null
+    done
+    wait 2>/dev/null
+    rm -rf "$WORK" "$SOCK"
+}
+trap cleanup EXIT
+
+check() {
+    local name=$1 expected=$2 actual=$3
+    if [[ "$actual" == *"$expected"* ]]; then
+        PASSED=$((PASSED + 1))
+        echo "PASS: $name"
+    else
+        FAILED=$((FAILED + 1))
+        echo "FAIL: $name"
+        echo "  expected to contain: $expected"
+        echo "  got: $actual"
+    fi
+}
+
+check_not() {
+    local name=$1 unexpected=$2 actual=$3
+    if [[ "$actual" != *"$unexpected"* ]]; then
+        PASSED=$((PASSED + 1))
+        echo "PASS: $name"
+    else
+        FAILED=$((FAILED + 1))
+        echo "FAIL: $name"
+        echo "  expected not to contain: $unexpected"
+        echo "  got: $actual"
+    fi
+}
+
+start_tcp_backend() {
+    $BACKEND "$BACKEND_PORT" T >/dev/null 2>&1 &
+    TCP_PID=$!
+    PIDS+=("$TCP_PID")
+}
+
+start_server() {
+    local port=$1
+    shift
+    $SERVER -p "$port" "$@" >"$WORK/server.$port.log" 2>&1 &
+    PIDS+=($!)
+}
+
+wait_for() {
+    for _ in $(seq 1 50); do
+        curl -s -o /dev/null "$1" && return 0
+        sleep 0.1
+    done
+    return 1
+}
+
+if [[ ! -x $SERVER || ! -x $BACKEND ]]; then
+    echo "Build first: make" >&2
+    exit 1
+fi
+
+start_tcp_backend
+$BACKEND "unix:$SOCK" U >/dev/null 2>&1 &
+PIDS+=($!)
+
+P_TCP=$((BASE_PORT + 1))
+P_UNIX=$((BASE_PORT + 2))
+P_RR=$((BASE_PORT + 3))
+P_LC=$((BASE_PORT + 4))
+P_ROOT=$((BASE_PORT + 5))
+
+sleep 0.3
+start_server $P_TCP -x /api -u "127.0.0.1:$BACKEND_PORT"
+start_server $P_UNIX -x /api/ -u "unix:$SOCK"
+start_server $P_RR -x /api -u "tcp:127.0.0.1:$BACKEND_PORT" -u "unix:$SOCK" -b rr
+start_server $P_LC -x /api -u "127.0.0.1:$BACKEND_PORT" -u "unix:$SOCK" -b lc
+start_server $P_ROOT -x / -u "unix:$SOCK"
+for port in $P_TCP $P_UNIX $P_RR $P_LC $P_ROOT; do
+    wait_for "http://localhost:$port/static/test.txt" || { echo "Server on $port did not start" >&2; exit 1; }
+done
+
+# Keep-alive pooling: consecutive requests reuse one upstream connection.
+first=$(curl -s "localhost:$P_TCP/api/pool")
+second=$(curl -s "localhost:$P_TCP/api/pool")
+conn=$(echo "$first" | sed -n 's/.*conn=\([0-9]*\).*/\1/p')
+check "prefix is stripped" "path=/pool " "$first"
+check "pooled connection reused" "conn=$conn req=2" "$second"
+
+# Unix-socket upstream and Host fallback.
+check "unix socket upstream" "U path=/x" "$(curl -s "localhost:$P_UNIX/api/x")"
+check "unix Host fallback" "Host: localhost" "$(curl -s -H 'Host:' "localhost:$P_UNIX/api/echo-headers")"
+check "tcp Host fallback" "Host: 127.0.0.1:$BACKEND_PORT" "$(curl -s -H 'Host:' "localhost:$P_RR/api/echo-headers")"
+
+# Hop-by-hop and body framing headers are not forwarded.
+headers=$(curl -s -m 5 -H 'Content-Length: 5' -H 'Connection: X-Secret' -H 'X-Secret: 1' \
+    "localhost:$P_TCP/api/echo-headers")
+check "GET with Content-Length answered" "GET /echo-headers" "$headers"
+check_not "Content-Length not forwarded" "Content-Length" "$headers"
+check_not "Connection-listed header not forwarded" "X-Secret" "$headers"
+
+# A catch-all "/" prefix leaves the built-in routes reachable.
+check "index served with -x /" "$(head -c 40 static/index.html)" "$(curl -s "localhost:$P_ROOT/")"
+check "calc served with -x /" "Calculation Result" "$(curl -s "localhost:$P_ROOT/calc/add/1/2")"
+check "other URIs proxied with -x /" "U path=/other" "$(curl -s "localhost:$P_ROOT/other")"
+
+# Round-robin alternates between the two upstreams.
+rr=$(for _ in 1 2 3 4; do curl -s "localhost:$P_RR/api/rr" | cut -c1; done | tr -d '\n')
+check "round-robin alternates" "TUTU" "$rr$rr"
+
+# Least connections avoids the upstream busy with a slow request.
+curl -s "localhost:$P_LC/api/slow" >"$WORK/slow" &
+sleep 0.3
+lc=$(for _ in 1 2 3; do curl -s "localhost:$P_LC/api/lc" | cut -c1; done | tr -d '\n')
+wait $!
+busy=$(cut -c1 "$WORK/slow")
+idle=$([[ $busy == T ]] && echo U || echo T)
+check "least connections" "$idle$idle$idle" "$lc"
+
+# Chunked relay, verbatim for HTTP/1.1 and unframed for HTTP/1.0.
+chunked11=$(curl -s -i "localhost:$P_TCP/api/chunked")
+check "chunked keeps framing for 1.1" "Transfer-Encoding: chunked" "$chunked11"
+check "chunked body for 1.1" "hello chunked world" "$chunked11"
+chunked10=$(curl -s -i --http1.0 "localhost:$P_TCP/api/chunked")
+check_not "chunked framing removed for 1.0" "Transfer-Encoding" "$chunked10"
+check "chunked body for 1.0" "hello chunked world" "$chunked10"
+check "connection reused after chunked" "conn=$conn req=" "$(curl -s "localhost:$P_TCP/api/after-chunked")"
+
+# Interim 1xx responses are skipped and the connection stays poolable.
+hints=$(curl -s -i -m 5 "localhost:$P_TCP/api/early-hints")
+check "final response after 103" "T path=/early-hints conn=$conn" "$hints"
+check_not "103 not relayed" "103" "$hints"
+check "connection reused after 103" "conn=$conn req=" "$(curl -s -m 5 "localhost:$P_TCP/api/after-hints")"
+check_not "Expect not forwarded" "Expect" \
+    "$(curl -s -m 5 -H 'Expect: 100-continue' "localhost:$P_TCP/api/echo-headers")"
+
+# Invalid or conflicting upstream Content-Length is a 502; identical duplicates are fine.
+for kind in negative garbage empty conflict; do
+    check "Content-Length $kind rejected" "502" \
+        "$(curl -s -o /dev/null -w '%{http_code}' -m 5 "localhost:$P_TCP/api/bad-length/$kind")"
+done
+check "duplicate equal Content-Length accepted" "ok 200" \
+    "$(curl -s -w ' %{http_code}' -m 5 "localhost:$P_TCP/api/bad-length/duplicate" | tr -d '\n')"
+
+# Content-Length and close-delimited bodies are streamed in full.
+check "large body" "1000000" "$(curl -s "localhost:$P_TCP/api/big" | wc -c)"
+check "close-delimited body" "200000" "$(curl -s "localhost:$P_TCP/api/eof" | wc -c)"
+
+# A pooled connection reset by the upstream is retried on a fresh one.
+curl -s -o /dev/null "localhost:$P_TCP/api/drop-next"
+check "stale connection retried" "200" "$(curl -s -o /dev/null -w '%{http_code}' "localhost:$P_TCP/api/after-reset")"
+
+# Backend restart: the pool is dropped and the upstream is used again right away.
+curl -s -o /dev/null "localhost:$P_TCP/api/warm"
+kill "$TCP_PID"
+wait "$TCP_PID" 2>/dev/null
+check "down upstream gives 502" "502" "$(curl -s -o /dev/null -w '%{http_code}' "localhost:$P_TCP/api/down")"
+start_tcp_backend
+sleep 0.3
+check "restarted upstream used immediately" "200" "$(curl -s -o /dev/null -w '%{http_code}' "localhost:$P_TCP/api/up")"
+check "health transitions logged" "is up" "$(grep Upstream "$WORK/server.$P_TCP.log")"
+
+echo "$PASSED passed, $FAILED failed"
+[[ $FAILED -eq 0 ]]
@@ -0,0 +1,120 @@
+#include "../trace.h"
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+// Name of the span that ends at each phase.
+static const char *phase_span_names[TRACE_PHASE_COUNT] = {
+    [TRACE_ACCEPT] = "accept",
+    [TRACE_FIRST_BYTE] = "wait",
+    [TRACE_HEADERS_PARSED] = "recv",
+    [TRACE_ROUTED] = "route",
+    [TRACE_FS_RESOLVED] = "fs",
+    [TRACE_HEADER_SENT] = "header",
+    [TRACE_BODY_DONE] = "body",
+};
+
+// Print a string as a JSON string literal.
+static void print_json_string(FILE *out, const char *s, size_t max_len) {
+    fputc('"', out);
+    for (size_t i = 0; i < max_len && s[i]; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\') {
+            fprintf(out, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+// Print one complete ("X") event; timestamps are converted to microseconds.
+static void print_event(FILE *out, int *first, const TraceRecord *rec, const char *name,
+                        uint64_t start_ns, uint64_t end_ns, uint64_t base_ns) {
+    fprintf(out, "%s\n{\"name\":", *first ? "" : ",");
+    *first = 0;
+    print_json_string(out, name, strlen(name));
+    fprintf(out, ",\"ph\":\"X\",\"pid\":1,\"tid\":%" PRIu64 ",\"ts\":%.3f,\"dur\":%.3f,"
+                 "\"args\":{\"seq\":%" PRIu64 ",\"status\":%" PRId32 ",\"uri\":",
+            rec->thread_id,
+            (double)(start_ns - base_ns) / 1e3, (double)(end_ns - start_ns) / 1e3,
+            rec->seq, rec->status_code);
+    print_json_string(out, rec->uri, sizeof(rec->uri));
+    fputs("}}", out);
+}
+
+// Convert a binary trace file written by http_server -T into Chrome trace JSON.
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s <trace_file> [output.json]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *in = fopen(argv[1], "rb");
+    if (!in) {
+        perror("fopen trace file");
+        return 1;
+    }
+
+    TraceFileHeader hdr;
+    if (fread(&hdr, sizeof(hdr), 1, in) != 1 ||
+        memcmp(hdr.magic, TRACE_FILE_MAGIC, sizeof(hdr.magic)) != 0 ||
+        hdr.version != TRACE_FILE_VERSION || hdr.phase_count != TRACE_PHASE_COUNT) {
+        fprintf(stderr, "Not a supported trace file: %s\n", argv[1]);
+        fclose(in);
+        return 1;
+    }
+
+    FILE *out = stdout;
+    if (argc == 3) {
+        out = fopen(argv[2], "w");
+        if (!out) {
+            perror("fopen output file");
+            fclose(in);
+            return 1;
+        }
+    }
+
+    // Timestamps are monotonic, so rebase on the earliest accept in the file.
+    uint64_t base_ns = UINT64_MAX;
+    TraceRecord rec;
+    while (fread(&rec, sizeof(rec), 1, in) == 1) {
+        if (rec.ts_ns[TRACE_ACCEPT] && rec.ts_ns[TRACE_ACCEPT] < base_ns) {
+            base_ns = rec.ts_ns[TRACE_ACCEPT];
+        }
+    }
+    fseek(in, sizeof(hdr), SEEK_SET);
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", out);
+
+    int first = 1;
+    size_t count = 0;
+    while (fread(&rec, sizeof(rec), 1, in) == 1) {
+        uint64_t start = rec.ts_ns[TRACE_ACCEPT];
+        uint64_t end = rec.ts_ns[TRACE_BODY_DONE];
+        if (start == 0 || end < start) continue;
+
+        char name[TRACE_METHOD_LEN + TRACE_URI_LEN + 2];
+        snprintf(name, sizeof(name), "%.*s %.*s",
+                 TRACE_METHOD_LEN, rec.method, TRACE_URI_LEN, rec.uri);
+        print_event(out, &first, &rec, name, start, end, base_ns);
+
+        uint64_t prev = start;
+        for (int phase = TRACE_FIRST_BYTE; phase < TRACE_PHASE_COUNT; phase++) {
+            uint64_t ts = rec.ts_ns[phase];
+            if (ts == 0 || ts < prev) continue;
+            print_event(out, &first, &rec, phase_span_names[phase], prev, ts, base_ns);
+            prev = ts;
+        }
+        count++;
+    }
+
+    fputs("\n]}\n", out);
+    fprintf(stderr, "Converted %zu requests.\n", count);
+
+    if (out != stdout) fclose(out);
+    fclose(in);
+    return 0;
+}
@@ -0,0 +1,89 @@
+#!/bin/bash
+# Exercise the Server-Timing header, the sampled -T trace file and trace2chrome.
+# Run from the repository root after `make` (or via `make check`).
+
+set -u
+
+PORT=${TRACE_TEST_PORT:-18470}
+WORK=$(mktemp -d)
+TRACE=$WORK/trace.bin
+
+SERVER=./http_server
+TOOL=./trace2chrome
+
+SERVER_PID=
+FAILED=0
+PASSED=0
+
+cleanup() {
+    [[ -n $SERVER_PID ]] && kill "$SERVER_PID" 2>/dev/null
+    wait 2>/dev/null
+    rm -rf "$WORK"
+}
+trap cleanup EXIT
+
+check() {
+    local name=$1 expected=$2 actual=$3
+    if [[ "$actual" == *"$expected"* ]]; then
+        PASSED=$((PASSED + 1))
+        echo "PASS: $name"
+    else
+        FAILED=$((FAILED + 1))
+        echo "FAIL: $name"
+        echo "  expected to contain: $expected"
+        echo "  got: $actual"
+    fi
+}
+
+start_server() {
+    $SERVER -p "$PORT" "$@" >"$WORK/server.log" 2>&1 &
+    SERVER_PID=$!
+    for _ in $(seq 1 50); do
+        curl -s -o /dev/null "localhost:$PORT/static/test.txt" && return 0
+        sleep 0.1
+    done
+    echo "Server on $PORT did not start" >&2
+    exit 1
+}
+
+stop_server() {
+    kill "$SERVER_PID"
+    wait "$SERVER_PID" 2>/dev/null
+    SERVER_PID=
+}
+
+if [[ ! -x $SERVER || ! -x $TOOL ]]; then
+    echo "Build first: make" >&2
+    exit 1
+fi
+
+# start_server's readiness probe is request 0; four more make five, so -s 2 keeps 0, 2 and 4.
+start_server -t -T "$TRACE" -s 2
+
+check "Server-Timing on static" "Server-Timing: wait;dur=" \
+    "$(curl -s -D - -o /dev/null "localhost:$PORT/static/test.txt")"
+check "static timing has fs phase" ", fs;dur=" \
+    "$(curl -s -D - -o /dev/null "localhost:$PORT/static/test.txt")"
+check "Server-Timing on calc" "pre-send;dur=" \
+    "$(curl -s -D - -o /dev/null "localhost:$PORT/calc/add/1/2")"
+check "Server-Timing on 405" "Server-Timing:" \
+    "$(curl -s -D - -o /dev/null -X POST "localhost:$PORT/static/test.txt")"
+stop_server
+
+json=$($TOOL "$TRACE" 2>"$WORK/convert.log")
+check "sampled record count" "Converted 3 requests." "$(cat "$WORK/convert.log")"
+check "trace2chrome output is JSON" "3" \
+    "$(echo "$json" | python3 -c 'import json, sys; d = json.load(sys.stdin); print(sum(" /" in e["name"] for e in d["traceEvents"]))')"
+
+# Reopening a compatible file appends; an incompatible one is refused.
+start_server -T "$TRACE"
+stop_server
+$TOOL "$TRACE" >/dev/null 2>"$WORK/convert.log"
+check "append to compatible file" "Converted 4 requests." "$(cat "$WORK/convert.log")"
+
+echo "not a trace file" >"$WORK/bad.bin"
+$SERVER -p "$PORT" -T "$WORK/bad.bin" >/dev/null 2>"$WORK/bad.log"
+check "incompatible file refused" "refusing to append" "$(cat "$WORK/bad.log") exit=$?"
+
+echo "$PASSED passed, $FAILED failed"
+[[ $FAILED -eq 0 ]]
@@ -0,0 +1,168 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "trace.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+static int server_timing_enabled = 0;
+static int trace_fd = -1;
+static unsigned trace_sample_rate = 1;
+static atomic_uint_fast64_t trace_seq;
+
+// Each connection runs on its own thread, so the active request lives in TLS.
+static _Thread_local TraceRecord current;
+static _Thread_local int current_active = 0;
+
+static int tracing_enabled(void) {
+    return server_timing_enabled || trace_fd != -1;
+}
+
+// Add a Server-Timing header to every response.
+void trace_enable_server_timing(void) {
+    server_timing_enabled = 1;
+}
+
+// Open (or append to) a binary trace file, recording one in every sample_rate requests.
+int trace_open_file(const char *path, unsigned sample_rate) {
+    int fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        perror("open trace file");
+        return -1;
+    }
+
+    TraceFileHeader hdr = {0};
+    memcpy(hdr.magic, TRACE_FILE_MAGIC, sizeof(hdr.magic));
+    hdr.version = TRACE_FILE_VERSION;
+    hdr.phase_count = TRACE_PHASE_COUNT;
+
+    off_t size = lseek(fd, 0, SEEK_END);
+    if (size == 0) {
+        if (write(fd, &hdr, sizeof(hdr)) != (ssize_t)sizeof(hdr)) {
+            perror("write trace header");
+            close(fd);
+            return -1;
+        }
+    } else {
+        // Appending records of a different layout would corrupt the file.
+        TraceFileHeader existing;
+        if (pread(fd, &existing, sizeof(existing), 0) != (ssize_t)sizeof(existing) ||
+            memcmp(&existing, &hdr, sizeof(hdr)) != 0 ||
+            (size - (off_t)sizeof(hdr)) % (off_t)sizeof(TraceRecord) != 0) {
+            fprintf(stderr, "Trace file %s has an incompatible format; refusing to append.\n", path);
+            close(fd);
+            return -1;
+        }
+    }
+
+    trace_fd = fd;
+    trace_sample_rate = sample_rate > 0 ? sample_rate : 1;
+    return 0;
+}
+
+// Close the trace file if one is open.
+void trace_close_file(void) {
+    if (trace_fd != -1) {
+        close(trace_fd);
+        trace_fd = -1;
+    }
+}
+
+// Current CLOCK_MONOTONIC time in nanoseconds.
+uint64_t trace_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Start tracing a new request on the calling thread.
+void trace_begin(uint64_t accept_ns) {
+    current_active = tracing_enabled();
+    if (!current_active) return;
+
+    memset(&current, 0, sizeof(current));
+    current.seq = atomic_fetch_add(&trace_seq, 1);
+    current.thread_id = (uint64_t)pthread_self();
+    current.ts_ns[TRACE_ACCEPT] = accept_ns ? accept_ns : trace_now();
+}
+
+// Record the time a phase was reached, overwriting any earlier mark.
+void trace_mark(TracePhase phase) {
+    if (!current_active) return;
+    current.ts_ns[phase] = trace_now();
+}
+
+// Record the time a phase was reached, only if it has not been marked yet.
+void trace_mark_once(TracePhase phase) {
+    if (!current_active || current.ts_ns[phase] != 0) return;
+    current.ts_ns[phase] = trace_now();
+}
+
+// Remember the method and URI for the trace record.
+void trace_set_request(const char *method, const char *uri) {
+    if (!current_active) return;
+    strncpy(current.method, method, sizeof(current.method) - 1);
+    strncpy(current.uri, uri, sizeof(current.uri) - 1);
+}
+
+// Remember the response status code for the trace record.
+void trace_set_status(int status_code) {
+    if (!current_active) return;
+    current.status_code = status_code;
+}
+
+// Append one "name;dur=<ms>" metric if both phases were reached.
+static int append_metric(char *buf, size_t size, int len, const char *name, uint64_t start, uint64_t end) {
+    if (start == 0 || end == 0 || end < start || len < 0 || (size_t)len >= size) {
+        return len;
+    }
+    return len + snprintf(buf + len, size - len, "%s%s;dur=%.3f",
+                          len > (int)strlen("Server-Timing: ") ? ", " : "",
+                          name, (double)(end - start) / 1e6);
+}
+
+// Format a "Server-Timing: ...\r\n" header line, or an empty string if disabled.
+// It is built before the header is sent, so "pre-send" excludes header and body
+// send time; those phases are only in the -T trace.
+int trace_format_server_timing(char *buf, size_t size) {
+    if (size == 0) return -1;
+    buf[0] = '\0';
+    if (!server_timing_enabled || !current_active) return 0;
+
+    const uint64_t *ts = current.ts_ns;
+    uint64_t now = trace_now();
+
+    int len = snprintf(buf, size, "Server-Timing: ");
+    len = append_metric(buf, size, len, "wait", ts[TRACE_ACCEPT], ts[TRACE_FIRST_BYTE]);
+    len = append_metric(buf, size, len, "recv", ts[TRACE_FIRST_BYTE], ts[TRACE_HEADERS_PARSED]);
+    len = append_metric(buf, size, len, "route", ts[TRACE_HEADERS_PARSED], ts[TRACE_ROUTED]);
+    len = append_metric(buf, size, len, "fs", ts[TRACE_ROUTED], ts[TRACE_FS_RESOLVED]);
+    len = append_metric(buf, size, len, "pre-send", ts[TRACE_ACCEPT], now);
+    if (len < 0 || (size_t)len + 2 >= size) {
+        buf[0] = '\0';
+        return -1;
+    }
+
+    buf[len++] = '\r';
+    buf[len++] = '\n';
+    buf[len] = '\0';
+    return len;
+}
+
+// Finish the current request and write its record if it was sampled.
+void trace_end(void) {
+    if (!current_active) return;
+    trace_mark(TRACE_BODY_DONE);
+    current_active = 0;
+
+    if (trace_fd == -1 || current.seq % trace_sample_rate != 0) return;
+
+    // O_APPEND writes of a single small record do not interleave across threads.
+    if (write(trace_fd, &current, sizeof(current)) != (ssize_t)sizeof(current)) {
+        perror("write trace record");
+    }
+}
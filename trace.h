@@ -0,0 +1,63 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    TRACE_ACCEPT = 0,
+    TRACE_FIRST_BYTE,
+    TRACE_HEADERS_PARSED,
+    TRACE_ROUTED,
+    TRACE_FS_RESOLVED,
+    TRACE_HEADER_SENT,
+    TRACE_BODY_DONE,
+    TRACE_PHASE_COUNT
+} TracePhase;
+
+#define TRACE_FILE_MAGIC "HTTRACE1"
+#define TRACE_FILE_VERSION 1
+#define TRACE_METHOD_LEN 16
+#define TRACE_URI_LEN 128
+
+// On-disk layout of a trace file: one TraceFileHeader followed by TraceRecords.
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t phase_count;
+} TraceFileHeader;
+
+// Monotonic nanosecond timestamps per phase; 0 means the phase was not reached.
+typedef struct {
+    uint64_t seq;
+    uint64_t thread_id;
+    uint64_t ts_ns[TRACE_PHASE_COUNT];
+    int32_t status_code;
+    uint32_t reserved;
+    char method[TRACE_METHOD_LEN];
+    char uri[TRACE_URI_LEN];
+} TraceRecord;
+
+void trace_enable_server_timing(void);
+
+int trace_open_file(const char *path, unsigned sample_rate);
+
+void trace_close_file(void);
+
+uint64_t trace_now(void);
+
+void trace_begin(uint64_t accept_ns);
+
+void trace_mark(TracePhase phase);
+
+void trace_mark_once(TracePhase phase);
+
+void trace_set_request(const char *method, const char *uri);
+
+void trace_set_status(int status_code);
+
+int trace_format_server_timing(char *buf, size_t size);
+
+void trace_end(void);
+
+#endif